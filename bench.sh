@@ -0,0 +1,29 @@
+#!/bin/bash -e
+
+# Runs release.o and release-pgo.o on every Nth seed of testset.txt (N = $1,
+# default 50) and compares iterations/sec and scores.
+
+readonly STEP=${1:-50}
+
+make release.o release-pgo.o CrystalLightingVis.class tools/score_report.o
+
+rm -rf bench
+mkdir -p bench/release bench/release-pgo
+
+test_case=0
+while read test_seed; do
+  if [ $((test_case % STEP)) -eq 0 ]; then
+    echo ${test_seed} >>bench/seeds.txt
+    for binary in release release-pgo; do
+      echo "Run "${binary}" on seed "${test_seed}
+      java CrystalLightingVis -exec "./${binary}.o" -seed ${test_seed} \
+        -novis >bench/${binary}/score_${test_seed}.txt
+    done
+  fi
+  test_case=$((test_case+1))
+done <testset.txt
+
+./tools/collect_results.sh bench/release bench/seeds.txt >bench/release.txt
+./tools/collect_results.sh bench/release-pgo bench/seeds.txt \
+  >bench/release-pgo.txt
+./tools/score_report.o bench/release.txt bench/release-pgo.txt
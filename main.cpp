@@ -3,7 +3,10 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <numeric>
@@ -31,6 +34,9 @@ constexpr uint8_t OBSTACLE = (0x3 << 6);
 constexpr uint8_t LANTERN_COLOR_MASK = 0x7;
 constexpr uint8_t CRYSTAL_COLOR_MASK = (0x7 << 3);
 
+// Board::energy is kept in units of 1 / ENERGY_SCALE.
+constexpr int64_t ENERGY_SCALE = 10000;
+
 constexpr int DIR_X[] = {0, 1, 0, -1};
 constexpr int DIR_Y[] = {-1, 0, 1, 0};
 constexpr int MIRROR_S_TO[] = {1, 0, 3, 2};
@@ -62,6 +68,26 @@ class Timer {
   const double time_limit_seconds_;
 };
 
+// Per-event contributions to Board::score and Board::energy. Crystal terms
+// are indexed by [crystal_color][lit_color].
+struct ObjectiveWeights {
+  int crystal_score[8][8];
+  int64_t crystal_energy[8][8];
+  int lantern_score;
+  int obstacle_score;
+  int mirror_score;
+  int64_t lantern_energy;
+  int64_t obstacle_energy;
+  int64_t mirror_energy;
+  int64_t good_lay_energy;
+  int64_t wrong_lay_energy;
+  int64_t invalid_lay_energy;
+  int64_t exceeded_mirror_energy;
+  int64_t exceeded_obstacle_energy;
+  int max_mirrors;
+  int max_obstacles;
+};
+
 struct Board {
   int w, h;
   vector<uint8_t> cells;
@@ -76,6 +102,11 @@ struct Board {
   int lit_compound_crystals;
   int lit_wrong_crystals;
   int crystals_nbit_off[4];
+  // Score ignoring validity and energy, both maintained together with the
+  // counters above once SetObjectiveWeights() is called.
+  int score;
+  int64_t energy;
+  ObjectiveWeights weights;
 
   inline void SetCell(int x, int y, uint8_t cell_value) {
     cells[y * w + x] = cell_value;
@@ -156,6 +187,15 @@ struct Board {
     return GetCell(x, y) == BACKSLASH_MIRROR;
   }
 
+  inline void UpdateCrystalObjective(uint8_t crystal_color,
+                                     uint8_t prev_lit_color,
+                                     uint8_t lit_color) {
+    score += weights.crystal_score[crystal_color][lit_color] -
+             weights.crystal_score[crystal_color][prev_lit_color];
+    energy += weights.crystal_energy[crystal_color][lit_color] -
+              weights.crystal_energy[crystal_color][prev_lit_color];
+  }
+
   inline void LayTrace(int x, int y, int dir, const uint8_t lantern_color) {
     assert(lantern_color);
     while (IsInBound(x, y) && SetLay(x, y, dir, lantern_color)) {
@@ -163,6 +203,7 @@ struct Board {
         break;
       } else if (IsLantern(x, y)) {
         ++invalid_lays;
+        energy += weights.invalid_lay_energy;
         break;
       } else if (IsSlashMirror(x, y)) {
         dir = MIRROR_S_TO[dir];
@@ -189,11 +230,14 @@ struct Board {
 
         --crystals_nbit_off[__builtin_popcount(prev_lit_color ^ crystal_color)];
         ++crystals_nbit_off[__builtin_popcount(lit_color ^ crystal_color)];
+        UpdateCrystalObjective(crystal_color, prev_lit_color, lit_color);
 
         if (lantern_color & crystal_color) {
           ++good_lays;
+          energy += weights.good_lay_energy;
         } else {
           ++wrong_lays;
+          energy += weights.wrong_lay_energy;
         }
 
         break;
@@ -215,6 +259,7 @@ struct Board {
         break;
       } else if (IsLantern(x, y)) {
         --invalid_lays;
+        energy -= weights.invalid_lay_energy;
         break;
       } else if (IsSlashMirror(x, y)) {
         dir = MIRROR_S_TO[dir];
@@ -239,11 +284,14 @@ struct Board {
 
         --crystals_nbit_off[__builtin_popcount(prev_lit_color ^ crystal_color)];
         ++crystals_nbit_off[__builtin_popcount(lit_color ^ crystal_color)];
+        UpdateCrystalObjective(crystal_color, prev_lit_color, lit_color);
 
         if (lantern_color & crystal_color) {
           --good_lays;
+          energy -= weights.good_lay_energy;
         } else {
           --wrong_lays;
+          energy -= weights.wrong_lay_energy;
         }
 
         break;
@@ -296,6 +344,8 @@ struct Board {
                lantern_color);
     }
     ++lanterns;
+    score += weights.lantern_score;
+    energy += weights.lantern_energy;
   }
 
   inline void RemoveLantern(int lantern_x, int lantern_y,
@@ -308,18 +358,30 @@ struct Board {
     }
     RemoveItem(lantern_x, lantern_y);
     --lanterns;
+    score -= weights.lantern_score;
+    energy -= weights.lantern_energy;
   }
 
   inline void PutObstacle(int obstacle_x, int obstacle_y) {
     assert(IsEmpty(obstacle_x, obstacle_y));
     PutItem(obstacle_x, obstacle_y, OBSTACLE);
     ++obstacles;
+    score += weights.obstacle_score;
+    energy += weights.obstacle_energy;
+    if (obstacles > weights.max_obstacles) {
+      energy += weights.exceeded_obstacle_energy;
+    }
   }
 
   inline void RemoveObstacle(int obstacle_x, int obstacle_y) {
     assert(IsObstacle(obstacle_x, obstacle_y));
     RemoveItem(obstacle_x, obstacle_y);
+    if (obstacles > weights.max_obstacles) {
+      energy -= weights.exceeded_obstacle_energy;
+    }
     --obstacles;
+    score -= weights.obstacle_score;
+    energy -= weights.obstacle_energy;
   }
 
   inline void PutMirror(int mirror_x, int mirror_y, uint8_t type) {
@@ -327,6 +389,11 @@ struct Board {
     assert(type == SLASH_MIRROR || type == BACKSLASH_MIRROR);
     PutItem(mirror_x, mirror_y, type);
     ++mirrors;
+    score += weights.mirror_score;
+    energy += weights.mirror_energy;
+    if (mirrors > weights.max_mirrors) {
+      energy += weights.exceeded_mirror_energy;
+    }
   }
 
   inline void RemoveMirror(int mirror_x, int mirror_y, uint8_t type) {
@@ -334,7 +401,40 @@ struct Board {
            IsBackslashMirror(mirror_x, mirror_y));
     assert(GetCell(mirror_x, mirror_y) == type);
     RemoveItem(mirror_x, mirror_y);
+    if (mirrors > weights.max_mirrors) {
+      energy -= weights.exceeded_mirror_energy;
+    }
     --mirrors;
+    score -= weights.mirror_score;
+    energy -= weights.mirror_energy;
+  }
+
+  // Installs new weights and recomputes score and energy from scratch.
+  void SetObjectiveWeights(const ObjectiveWeights& new_weights) {
+    weights = new_weights;
+    score = lanterns * weights.lantern_score +
+            obstacles * weights.obstacle_score +
+            mirrors * weights.mirror_score;
+    energy = lanterns * weights.lantern_energy +
+             obstacles * weights.obstacle_energy +
+             mirrors * weights.mirror_energy +
+             good_lays * weights.good_lay_energy +
+             wrong_lays * weights.wrong_lay_energy +
+             invalid_lays * weights.invalid_lay_energy +
+             max(0, mirrors - weights.max_mirrors) *
+                 weights.exceeded_mirror_energy +
+             max(0, obstacles - weights.max_obstacles) *
+                 weights.exceeded_obstacle_energy;
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        if (IsCrystal(x, y)) {
+          uint8_t crystal_color = GetCrystalColor(x, y);
+          uint8_t lit_color = GetLitColor(x, y);
+          score += weights.crystal_score[crystal_color][lit_color];
+          energy += weights.crystal_energy[crystal_color][lit_color];
+        }
+      }
+    }
   }
 
 #ifdef ENABLE_INTERNAL_STATE_CHECK
@@ -463,21 +563,231 @@ struct Board {
       cerr << invalid_lays << " != " << local_invalid_lays << endl;
     }
     assert(invalid_lays == local_invalid_lays);
+
+    Board recomputed = *this;
+    recomputed.SetObjectiveWeights(weights);
+    if (score != recomputed.score || energy != recomputed.energy) {
+      cerr << message << endl;
+      cerr << "score: " << score << " != " << recomputed.score
+           << ", energy: " << energy << " != " << recomputed.energy << endl;
+    }
+    assert(score == recomputed.score);
+    assert(energy == recomputed.energy);
   }
 #endif
 };
 
+// Weights of the annealing energy and shape of the cooling schedule. The
+// defaults are the hand-tuned values; tools/tune.cpp searches for better ones.
+struct EnergyParams {
+  double lit_crystal = 2.0;
+  double lit_compound_crystal = 3.0;
+  double lit_wrong_crystal = -1.0;
+  // Multiplied by the per-item cost of the test case.
+  double lantern_cost = -0.1;
+  double obstacle_cost = -0.1;
+  double mirror_cost = -0.1;
+  double crystal_1bit_off = -0.1;
+  double crystal_2bit_off = -0.3;
+  double crystal_3bit_off = -0.6;
+  double good_lay = 0.08;
+  double wrong_lay = -0.1;
+  double invalid_lay = -2.0;
+  double exceeded_mirror = -10.0;
+  double exceeded_obstacle = -10.0;
+  // T(t) = max(initial_temperature * (1 - t)^temperature_exponent,
+  //            min_temperature) for the normalized time t.
+  double initial_temperature = 1.0;
+  double temperature_exponent = 1.0;
+  double min_temperature = 0.0001;
+};
+
+const vector<pair<string, double EnergyParams::*>>& GetEnergyParamFields() {
+  static const vector<pair<string, double EnergyParams::*>> fields = {
+      {"lit_crystal", &EnergyParams::lit_crystal},
+      {"lit_compound_crystal", &EnergyParams::lit_compound_crystal},
+      {"lit_wrong_crystal", &EnergyParams::lit_wrong_crystal},
+      {"lantern_cost", &EnergyParams::lantern_cost},
+      {"obstacle_cost", &EnergyParams::obstacle_cost},
+      {"mirror_cost", &EnergyParams::mirror_cost},
+      {"crystal_1bit_off", &EnergyParams::crystal_1bit_off},
+      {"crystal_2bit_off", &EnergyParams::crystal_2bit_off},
+      {"crystal_3bit_off", &EnergyParams::crystal_3bit_off},
+      {"good_lay", &EnergyParams::good_lay},
+      {"wrong_lay", &EnergyParams::wrong_lay},
+      {"invalid_lay", &EnergyParams::invalid_lay},
+      {"exceeded_mirror", &EnergyParams::exceeded_mirror},
+      {"exceeded_obstacle", &EnergyParams::exceeded_obstacle},
+      {"initial_temperature", &EnergyParams::initial_temperature},
+      {"temperature_exponent", &EnergyParams::temperature_exponent},
+      {"min_temperature", &EnergyParams::min_temperature},
+  };
+  return fields;
+}
+
+// Reads "name = value" lines. Unknown names and malformed lines are errors;
+// names that are not mentioned keep their current value.
+bool ReadEnergyParams(istream& is, EnergyParams* params) {
+  string line;
+  while (getline(is, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    stringstream ss(line);
+    string name, eq;
+    double value;
+    if (!(ss >> name >> eq >> value) || eq != "=") {
+      return false;
+    }
+    bool found = false;
+    for (const auto& field : GetEnergyParamFields()) {
+      if (field.first == name) {
+        params->*field.second = value;
+        found = true;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void WriteEnergyParams(ostream& os, const EnergyParams& params) {
+  for (const auto& field : GetEnergyParamFields()) {
+    os << field.first << " = " << params.*field.second << endl;
+  }
+}
+
 struct OptimizerResult {
   int score;
   vector<uint8_t> cells;
+  int64_t iterations;
+};
+
+// Adaptive pursuit over a small set of arms (Thierens, 2005). Acceptances
+// and net energy drops are only accumulated per play; the owner folds them
+// into the selection probabilities by calling Update() once in a while, so a
+// proposal costs one 32-bit draw and two adds.
+//
+// Each batch is scored relative to its best arm, so the quality of an arm is
+// an average of values in [0, 1] and does not depend on the energy scale or
+// the temperature. Once no arm keeps paying off, the probabilities relax
+// back to the initial mix instead of staying on the last leader.
+class AdaptivePursuit {
+ public:
+  AdaptivePursuit(const vector<double>& initial_probs, double min_prob,
+                  double adaptation_rate, double learning_rate)
+      : initial_probs_(initial_probs),
+        probs_(initial_probs),
+        thresholds_(initial_probs.size() - 1),
+        quality_(initial_probs.size(), 0.0),
+        accepts_(initial_probs.size(), 0),
+        energy_drops_(initial_probs.size(), 0),
+        plays_(initial_probs.size(), 0),
+        min_prob_(min_prob),
+        max_prob_(1.0 - (initial_probs.size() - 1) * min_prob),
+        adaptation_rate_(adaptation_rate),
+        learning_rate_(learning_rate) {
+    assert(!initial_probs.empty());
+    assert(max_prob_ >= min_prob_);
+    UpdateThresholds();
+  }
+
+  template <class Generator>
+  inline int Select(Generator& gen) const {
+    uint32_t r = gen();
+    int arm = 0;
+    for (uint32_t threshold : thresholds_) {
+      arm += r >= threshold;
+    }
+    return arm;
+  }
+
+  // energy_drop is signed: accepted uphill moves count against the arm.
+  inline void AddReward(int arm, bool accepted, int64_t energy_drop) {
+    ++plays_[arm];
+    accepts_[arm] += accepted;
+    energy_drops_[arm] += energy_drop;
+  }
+
+  void Update() {
+    double best_acceptance = 0;
+    double best_energy_drop = 0;
+    for (int arm = 0; arm < plays_.size(); ++arm) {
+      if (plays_[arm]) {
+        best_acceptance =
+            max(best_acceptance, double(accepts_[arm]) / plays_[arm]);
+        best_energy_drop =
+            max(best_energy_drop, double(energy_drops_[arm]) / plays_[arm]);
+      }
+    }
+    int best_arm = 0;
+    for (int arm = 0; arm < quality_.size(); ++arm) {
+      if (plays_[arm]) {
+        // Half acceptance rate, half net improvement, each relative to the
+        // best arm of the batch.
+        double reward = 0;
+        if (best_acceptance >= kMinAcceptanceRate) {
+          reward += 0.5 * accepts_[arm] / plays_[arm] / best_acceptance;
+        }
+        if (best_energy_drop > 0) {
+          reward += 0.5 * max(0.0, double(energy_drops_[arm]) / plays_[arm]) /
+                    best_energy_drop;
+        }
+        quality_[arm] += adaptation_rate_ * (reward - quality_[arm]);
+        accepts_[arm] = 0;
+        energy_drops_[arm] = 0;
+        plays_[arm] = 0;
+      }
+      if (quality_[arm] > quality_[best_arm]) {
+        best_arm = arm;
+      }
+    }
+    for (int arm = 0; arm < probs_.size(); ++arm) {
+      double target = quality_[best_arm] < kMinQuality
+                          ? initial_probs_[arm]
+                          : arm == best_arm ? max_prob_ : min_prob_;
+      probs_[arm] += learning_rate_ * (target - probs_[arm]);
+    }
+    UpdateThresholds();
+  }
+
+ private:
+  // Below this quality no arm is considered to be paying off.
+  static constexpr double kMinQuality = 0.05;
+  // Batch acceptance rates below this are treated as no signal.
+  static constexpr double kMinAcceptanceRate = 1e-3;
+
+  // Arm i is selected for draws in [thresholds_[i - 1], thresholds_[i]).
+  void UpdateThresholds() {
+    double cumulative = 0;
+    for (int arm = 0; arm < thresholds_.size(); ++arm) {
+      cumulative += probs_[arm];
+      thresholds_[arm] = uint32_t(min(cumulative * 4294967296.0, 4294967295.0));
+    }
+  }
+
+  const vector<double> initial_probs_;
+  vector<double> probs_;
+  vector<uint32_t> thresholds_;
+  vector<double> quality_;
+  vector<int> accepts_;
+  vector<int64_t> energy_drops_;
+  vector<int> plays_;
+  const double min_prob_;
+  const double max_prob_;
+  const double adaptation_rate_;
+  const double learning_rate_;
 };
 
 class Optimizer {
  public:
-  Optimizer(const Timer& timer, const Board& initial_board, int cost_lantern,
-            int cost_mirror, int cost_obstacle, int max_mirrors,
-            int max_obstacles)
+  Optimizer(const Timer& timer, const EnergyParams& params,
+            const Board& initial_board, int cost_lantern, int cost_mirror,
+            int cost_obstacle, int max_mirrors, int max_obstacles)
       : timer_(&timer),
+        params_(params),
         board_width_(initial_board.w),
         board_height_(initial_board.h),
         initial_board_(initial_board),
@@ -486,7 +796,60 @@ class Optimizer {
         cost_obstacle_(cost_obstacle),
         max_mirrors_(max_mirrors),
         max_obstacles_(max_obstacles),
-        board_(initial_board) {}
+        board_(initial_board) {
+    board_.SetObjectiveWeights(GetObjectiveWeights(&energy_rounding_error_));
+  }
+
+  // Also reports the largest error, in energy units, made by rounding a
+  // single weight to the 1 / ENERGY_SCALE grid.
+  ObjectiveWeights GetObjectiveWeights(double* max_rounding_error) const {
+    *max_rounding_error = 0;
+    auto to_energy = [max_rounding_error](double weight) {
+      int64_t scaled = -llround(weight * ENERGY_SCALE);
+      *max_rounding_error =
+          max(*max_rounding_error,
+              abs(double(scaled) / ENERGY_SCALE + weight));
+      return scaled;
+    };
+    const double crystal_nbit_off[] = {0, params_.crystal_1bit_off,
+                                       params_.crystal_2bit_off,
+                                       params_.crystal_3bit_off};
+    ObjectiveWeights weights = {};
+    for (uint8_t crystal_color = 1; crystal_color < 8; ++crystal_color) {
+      bool secondary = crystal_color == GREEN || crystal_color == VIOLET ||
+                       crystal_color == ORANGE;
+      for (uint8_t lit_color = 0; lit_color < 8; ++lit_color) {
+        int score = 0;
+        double energy = crystal_nbit_off[__builtin_popcount(
+            crystal_color ^ lit_color)];
+        if (lit_color == crystal_color) {
+          score = secondary ? 30 : 20;
+          energy += secondary ? params_.lit_compound_crystal
+                              : params_.lit_crystal;
+        } else if (lit_color != 0) {
+          score = -10;
+          energy += params_.lit_wrong_crystal;
+        }
+        weights.crystal_score[crystal_color][lit_color] = score;
+        weights.crystal_energy[crystal_color][lit_color] = to_energy(energy);
+      }
+    }
+    weights.lantern_score = -cost_lantern_;
+    weights.obstacle_score = -cost_obstacle_;
+    weights.mirror_score = -cost_mirror_;
+    weights.lantern_energy = to_energy(params_.lantern_cost * cost_lantern_);
+    weights.obstacle_energy =
+        to_energy(params_.obstacle_cost * cost_obstacle_);
+    weights.mirror_energy = to_energy(params_.mirror_cost * cost_mirror_);
+    weights.good_lay_energy = to_energy(params_.good_lay);
+    weights.wrong_lay_energy = to_energy(params_.wrong_lay);
+    weights.invalid_lay_energy = to_energy(params_.invalid_lay);
+    weights.exceeded_mirror_energy = to_energy(params_.exceeded_mirror);
+    weights.exceeded_obstacle_energy = to_energy(params_.exceeded_obstacle);
+    weights.max_mirrors = max_mirrors_;
+    weights.max_obstacles = max_obstacles_;
+    return weights;
+  }
 
   inline void MaybeUpdateResult() {
     int score = GetScore();
@@ -501,82 +864,207 @@ class Optimizer {
         board_.obstacles > max_obstacles_) {
       return -1;
     }
-    return board_.lit_crystals * 20 + board_.lit_compound_crystals * 30 -
-           board_.lit_wrong_crystals * 10 - board_.lanterns * cost_lantern_ -
-           board_.obstacles * cost_obstacle_ - board_.mirrors * cost_mirror_;
+    return board_.score;
   }
 
+  // Bound on |board_.energy / ENERGY_SCALE - GetEnergy()|: every weighted
+  // event may carry the rounding error of its weight, plus slack for the
+  // floating point sum in GetEnergy().
+  double GetEnergyTolerance() const {
+    int events = board_.lanterns + board_.obstacles + board_.mirrors +
+                 board_.good_lays + board_.wrong_lays + board_.invalid_lays +
+                 max(0, board_.mirrors - max_mirrors_) +
+                 max(0, board_.obstacles - max_obstacles_);
+    for (int bits = 0; bits < 4; ++bits) {
+      // Each crystal contributes one [crystal_color][lit_color] entry.
+      events += board_.crystals_nbit_off[bits];
+    }
+    return energy_rounding_error_ * events + 1e-6;
+  }
+
+  // Reference implementation of board_.energy / ENERGY_SCALE, used to check
+  // the incremental fixed-point energy in debug builds.
   inline double GetEnergy() const {
     double exceeded_mirrors = max(0, board_.mirrors - max_mirrors_);
     double exceeded_obstacles = max(0, board_.obstacles - max_obstacles_);
-    return -(2.0 * board_.lit_crystals + 3.0 * board_.lit_compound_crystals +
-             -1.0 * board_.lit_wrong_crystals +
-             -0.1 * board_.lanterns * cost_lantern_ +
-             -0.1 * board_.obstacles * cost_obstacle_ +
-             -0.1 * board_.mirrors * cost_mirror_ +
-             -0.1 * board_.crystals_nbit_off[1] +
-             -0.3 * board_.crystals_nbit_off[2] +
-             -0.6 * board_.crystals_nbit_off[3] + +0.08 * board_.good_lays +
-             -0.1 * board_.wrong_lays + -2.0 * board_.invalid_lays +
-             -10.0 * exceeded_mirrors + -10.0 * exceeded_obstacles);
+    return -(params_.lit_crystal * board_.lit_crystals +
+             params_.lit_compound_crystal * board_.lit_compound_crystals +
+             params_.lit_wrong_crystal * board_.lit_wrong_crystals +
+             params_.lantern_cost * board_.lanterns * cost_lantern_ +
+             params_.obstacle_cost * board_.obstacles * cost_obstacle_ +
+             params_.mirror_cost * board_.mirrors * cost_mirror_ +
+             params_.crystal_1bit_off * board_.crystals_nbit_off[1] +
+             params_.crystal_2bit_off * board_.crystals_nbit_off[2] +
+             params_.crystal_3bit_off * board_.crystals_nbit_off[3] +
+             params_.good_lay * board_.good_lays +
+             params_.wrong_lay * board_.wrong_lays +
+             params_.invalid_lay * board_.invalid_lays +
+             params_.exceeded_mirror * exceeded_mirrors +
+             params_.exceeded_obstacle * exceeded_obstacles);
   }
 
   inline double GetTemperature() const {
-    return max(1.0 - timer_->GetNormalizedTime(), 0.0001);
+    double remaining = 1.0 - timer_->GetNormalizedTime();
+    if (params_.temperature_exponent != 1.0) {
+      remaining = pow(remaining, params_.temperature_exponent);
+    }
+    return max(params_.initial_temperature * remaining,
+               params_.min_temperature);
   }
 
   void SimulatedAnnealing() {
     mt19937 gen;
-    vector<pair<int, int>> available_positions;
+    constexpr int kRegionsPerSide = 4;
+    vector<vector<pair<int, int>>> region_positions(kRegionsPerSide *
+                                                    kRegionsPerSide);
+    int num_available_positions = 0;
     for (int y = 0; y < board_height_; ++y) {
       for (int x = 0; x < board_width_; ++x) {
         if (initial_board_.IsEmpty(x, y)) {
-          available_positions.emplace_back(make_pair(x, y));
+          int region = (y * kRegionsPerSide / board_height_) * kRegionsPerSide +
+                       x * kRegionsPerSide / board_width_;
+          region_positions[region].emplace_back(make_pair(x, y));
+          ++num_available_positions;
         }
       }
     }
-    uniform_int_distribution<int> rand_next_pos(0,
-                                                available_positions.size() - 1);
-    uniform_real_distribution<double> rand_prob(0, 1);
+    region_positions.erase(
+        remove_if(region_positions.begin(), region_positions.end(),
+                  [](const vector<pair<int, int>>& positions) {
+                    return positions.empty();
+                  }),
+        region_positions.end());
+    if (region_positions.empty()) {
+      return;
+    }
+    vector<double> region_probs;
+    for (const auto& positions : region_positions) {
+      region_probs.push_back(double(positions.size()) /
+                             num_available_positions);
+    }
+    AdaptivePursuit region_proposer(
+        region_probs, /*min_prob=*/0.8 / region_positions.size(),
+        /*adaptation_rate=*/0.3, /*learning_rate=*/0.05);
+
+    // Placing a lantern on a lit cell almost always invalidates it, so the
+    // lantern arm starts at (and may not drop below) the old fixed 0.1%.
+    // Arm 0 places an item, arm 1 places a lantern.
+    constexpr int kPlaceLantern = 1;
+    AdaptivePursuit lit_cell_proposer({0.999, 0.001}, /*min_prob=*/0.001,
+                                      /*adaptation_rate=*/0.3,
+                                      /*learning_rate=*/0.05);
+
+    // Which mirror orientation helps depends on the cell, not on the
+    // instance, so both share one arm and the orientation is drawn uniformly.
+    // With both kinds allowed the arms start at the old 2:1 mix of uniform
+    // '/', '\' and 'X'.
+    vector<uint8_t> item_types;
+    vector<double> item_probs;
+    if (max_mirrors_ > 0) {
+      item_types.push_back(SLASH_MIRROR);
+      item_probs.push_back(max_obstacles_ > 0 ? 2.0 / 3 : 1.0);
+    }
+    if (max_obstacles_ > 0) {
+      item_types.push_back(OBSTACLE);
+      item_probs.push_back(max_mirrors_ > 0 ? 1.0 / 3 : 1.0);
+    }
+    if (item_types.empty()) {
+      // Never proposed; keeps the proposer non-empty.
+      item_types.push_back(EMPTY_CELL);
+      item_probs.push_back(1.0);
+    }
+    AdaptivePursuit item_proposer(item_probs,
+                                  /*min_prob=*/0.1 / item_types.size(),
+                                  /*adaptation_rate=*/0.3,
+                                  /*learning_rate=*/0.05);
+
+    // An uphill move of delta is accepted with probability exp(-delta / T),
+    // i.e. when delta < -log(u) * T for a uniform u. -log(u) is tabulated at
+    // 2^10 points (8KB, so lookups stay in L1) and turned into thresholds in
+    // energy units whenever the temperature is refreshed, so accepting a move
+    // is one lookup and an integer compare.
+    constexpr int kNegLogTableBits = 10;
+    vector<double> neg_log_table(1 << kNegLogTableBits);
+    for (int i = 0; i < neg_log_table.size(); ++i) {
+      neg_log_table[i] =
+          -log((i + 0.5) / neg_log_table.size()) * ENERGY_SCALE;
+    }
+    vector<int64_t> accept_thresholds(neg_log_table.size());
+    auto update_accept_thresholds = [&neg_log_table, &accept_thresholds,
+                                     this]() {
+      const double temperature = GetTemperature();
+      for (int i = 0; i < neg_log_table.size(); ++i) {
+        accept_thresholds[i] = int64_t(neg_log_table[i] * temperature);
+      }
+    };
+    update_accept_thresholds();
 
-    double energy = GetEnergy();
-    double best_energy = energy;
-    auto accept = [&energy, &best_energy, &rand_prob, &gen, this]() {
+    int64_t energy = board_.energy;
+    int64_t best_energy = energy;
+    bool accepted = false;
+    auto accept = [&energy, &best_energy, &accepted, &accept_thresholds,
+                   &gen, this]() {
 #ifdef ENABLE_INTERNAL_STATE_CHECK
       board_.CheckInternalStateForDebug("accept lambda", initial_board_);
+#endif
+#ifdef LOCAL_DEBUG_MODE
+      assert(abs(double(board_.energy) / ENERGY_SCALE - GetEnergy()) <
+             GetEnergyTolerance());
 #endif
       MaybeUpdateResult();
-      double new_energy = GetEnergy();
+      int64_t new_energy = board_.energy;
       if (new_energy <= energy ||
-          rand_prob(gen) < exp(-(new_energy - energy) / GetTemperature())) {
+          new_energy - energy <
+              accept_thresholds[gen() & ((1 << kNegLogTableBits) - 1)]) {
         best_energy = min(best_energy, new_energy);
         energy = new_energy;
+        accepted = true;
         return true;
       }
       return false;
     };
     while (!timer_->IsTimeout()) {
+      ++result_.iterations;
 #ifdef LOCAL_DEBUG_MODE
       if (next_report_time_ < timer_->GetNormalizedTime()) {
         cerr << "time: " << next_report_time_ << ", temp: " << GetTemperature()
              << ", invalid_lays: " << board_.invalid_lays
              << ", obstacles: " << board_.obstacles << "/" << max_obstacles_
              << ", mirrors: " << board_.mirrors << "/" << max_mirrors_
-             << ", energy: " << energy << ", best_energy: " << best_energy
+             << ", energy: " << double(energy) / ENERGY_SCALE
+             << ", best_energy: " << double(best_energy) / ENERGY_SCALE
              << ", score: " << GetScore() << ", best_score: " << result_.score
              << endl;
         next_report_time_ += 0.1;
       }
 #endif
 
-      const auto& next_pos = available_positions[rand_next_pos(gen)];
+      const int64_t prev_energy = energy;
+      accepted = false;
+      if ((result_.iterations & 1023) == 0) {
+        lit_cell_proposer.Update();
+        item_proposer.Update();
+        if ((result_.iterations & 4095) == 0) {
+          region_proposer.Update();
+          update_accept_thresholds();
+        }
+      }
+
+      const int region = region_proposer.Select(gen);
+      const auto& positions = region_positions[region];
+      const auto& next_pos =
+          positions[(uint64_t(gen()) * positions.size()) >> 32];
       int x = next_pos.first;
       int y = next_pos.second;
+      int lit_cell_move = -1;
+      int item_arm = -1;
       if (board_.IsEmpty(x, y)) {
-        bool create_lantern =
-            !board_.HasLay(x, y) ||
-            (max_mirrors_ == 0 && max_obstacles_ == 0) ||
-            uniform_real_distribution<double>(0, 1.0)(gen) < 0.001;
+        bool create_lantern = !board_.HasLay(x, y) ||
+                              (max_mirrors_ == 0 && max_obstacles_ == 0);
+        if (!create_lantern) {
+          lit_cell_move = lit_cell_proposer.Select(gen);
+          create_lantern = lit_cell_move == kPlaceLantern;
+        }
         if (create_lantern) {
           int prev_good_lays = board_.good_lays;
           int prev_wrong_lays = board_.wrong_lays;
@@ -589,26 +1077,26 @@ class Optimizer {
           }
         } else {
           assert(max_mirrors_ || max_obstacles_);
-          uint8_t item_type = uniform_int_distribution<int>(1, 3)(gen) << 6;
-          if (max_obstacles_ == 0) {
-            item_type = uniform_int_distribution<int>(1, 2)(gen) << 6;
-          }
-          if (max_mirrors_ == 0) {
-            item_type = OBSTACLE;
-          }
-          if (item_type == OBSTACLE) {
-            if (board_.obstacles < max_obstacles_) {
-              board_.PutObstacle(x, y);
-              if (!accept()) {
-                board_.RemoveObstacle(x, y);
-              }
+          item_arm = item_proposer.Select(gen);
+          // A move blocked by the budget tells nothing about any arm, so it
+          // is not counted. Items of a full type move around as an accepted
+          // removal followed by a placement, which is what gets credited.
+          if (item_types[item_arm] == OBSTACLE) {
+            if (board_.obstacles >= max_obstacles_) {
+              continue;
+            }
+            board_.PutObstacle(x, y);
+            if (!accept()) {
+              board_.RemoveObstacle(x, y);
             }
           } else {
-            if (board_.mirrors < max_mirrors_) {
-              board_.PutMirror(x, y, item_type);
-              if (!accept()) {
-                board_.RemoveMirror(x, y, item_type);
-              }
+            if (board_.mirrors >= max_mirrors_) {
+              continue;
+            }
+            const uint8_t type = gen() & 1 ? SLASH_MIRROR : BACKSLASH_MIRROR;
+            board_.PutMirror(x, y, type);
+            if (!accept()) {
+              board_.RemoveMirror(x, y, type);
             }
           }
         }
@@ -633,6 +1121,15 @@ class Optimizer {
           }
         }
       }
+
+      const int64_t energy_drop = prev_energy - energy;
+      region_proposer.AddReward(region, accepted, energy_drop);
+      if (lit_cell_move >= 0) {
+        lit_cell_proposer.AddReward(lit_cell_move, accepted, energy_drop);
+      }
+      if (item_arm >= 0) {
+        item_proposer.AddReward(item_arm, accepted, energy_drop);
+      }
     }
   }
 
@@ -652,6 +1149,7 @@ class Optimizer {
 
  private:
   const Timer* timer_;
+  const EnergyParams params_;
   const int board_width_;
   const int board_height_;
   const Board initial_board_;
@@ -662,6 +1160,7 @@ class Optimizer {
   const int max_obstacles_;
 
   Board board_;
+  double energy_rounding_error_;
   OptimizerResult result_ = {};
 
 #ifdef LOCAL_DEBUG_MODE
@@ -695,9 +1194,10 @@ class CrystalLighting {
       }
     }
     const OptimizerResult& result =
-        Optimizer(timer, board, cost_lantern, cost_mirror, cost_obstacle,
-                  max_mirrors, max_obstacles)
+        Optimizer(timer, params, board, cost_lantern, cost_mirror,
+                  cost_obstacle, max_mirrors, max_obstacles)
             .Optimize();
+    iterations = result.iterations;
 
     vector<string> ret;
     for (int y = 0; y < board.h; ++y) {
@@ -726,6 +1226,10 @@ class CrystalLighting {
     }
     return ret;
   }
+
+  EnergyParams params;
+  // Number of annealing steps taken by the last placeItems call.
+  int64_t iterations = 0;
 };
 
 #ifdef LOCAL_ENTRY_POINT_FOR_TESTING
@@ -737,6 +1241,14 @@ void getVector(vector<T>& v) {
 
 int main() {
   CrystalLighting cl;
+  // Set by tools/tune.cpp to evaluate candidate parameters.
+  if (const char* params_path = getenv("CRYSTAL_LIGHTING_PARAMS")) {
+    ifstream ifs(params_path);
+    if (!ifs || !ReadEnergyParams(ifs, &cl.params)) {
+      cerr << "Failed to read parameters from " << params_path << endl;
+      return 1;
+    }
+  }
   int H;
   cin >> H;
   vector<string> targetBoard(H);
@@ -745,8 +1257,21 @@ int main() {
   cin >> costLantern >> costMirror >> costObstacle >> maxMirrors >>
       maxObstacles;
 
+  auto start_time = chrono::steady_clock::now();
   vector<string> ret = cl.placeItems(targetBoard, costLantern, costMirror,
                                      costObstacle, maxMirrors, maxObstacles);
+  chrono::duration<double> run_time = chrono::steady_clock::now() - start_time;
+
+  // The visualizer copies stderr to its stdout, next to "Score = N";
+  // tools/collect_results.sh picks these up. Written before the answer, as
+  // the visualizer may kill the process as soon as it has read it.
+  cerr << "Iterations = " << cl.iterations << endl;
+  cerr << "RunTime = " << run_time.count() << endl;
+  cerr << "Height = " << H << endl;
+  cerr << "Width = " << targetBoard[0].size() << endl;
+  cerr << "MaxMirrors = " << maxMirrors << endl;
+  cerr << "MaxObstacles = " << maxObstacles << endl;
+
   cout << ret.size() << endl;
   for (int i = 0; i < (int)ret.size(); ++i) cout << ret[i] << endl;
   cout.flush();
@@ -0,0 +1,25 @@
+#!/bin/bash -e
+
+# Joins <scores dir>/score_<seed>.txt for every seed in <seeds file> into one
+# columnar results file on stdout. Values a run did not report (e.g. from
+# older binaries) are written as "-".
+#
+# Usage: ./tools/collect_results.sh [scores dir [seeds file]]
+
+readonly SCORES_DIR=${1:-scores}
+readonly SEEDS=${2:-testset.txt}
+
+echo "seed score iterations run_time height width max_mirrors max_obstacles"
+while read test_seed; do
+  awk -v seed=${test_seed} '
+    BEGIN { for (i = 1; i <= 7; i++) v[i] = "-" }
+    $1 == "Score" && $2 == "=" { v[1] = $3 }
+    $1 == "Iterations" && $2 == "=" { v[2] = $3 }
+    $1 == "RunTime" && $2 == "=" { v[3] = $3 }
+    $1 == "Height" && $2 == "=" { v[4] = $3 }
+    $1 == "Width" && $2 == "=" { v[5] = $3 }
+    $1 == "MaxMirrors" && $2 == "=" { v[6] = $3 }
+    $1 == "MaxObstacles" && $2 == "=" { v[7] = $3 }
+    END { print seed, v[1], v[2], v[3], v[4], v[5], v[6], v[7] }
+  ' ${SCORES_DIR}/score_${test_seed}.txt
+done <${SEEDS}
@@ -0,0 +1,59 @@
+// Writes a test case in the solution's stdin format, drawn from the same
+// distributions as CrystalLightingVis.generate(). The boards differ from the
+// visualizer's for the same seed (mt19937 instead of SHA1PRNG), but they let
+// the solution run without the visualizer, e.g. for PGO training.
+//
+// Usage: ./tools/gen_input.o SEED
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    cerr << "Usage: " << argv[0] << " SEED" << endl;
+    return 1;
+  }
+  mt19937 gen(strtoul(argv[1], nullptr, 10));
+  auto rand_int = [&gen](int lo, int hi) {
+    return uniform_int_distribution<int>(lo, hi)(gen);
+  };
+
+  int h = rand_int(10, 100);
+  int w = rand_int(10, 100);
+  int p_obstacle = rand_int(5, 15);
+  int p_crystal = rand_int(15, 25);
+  vector<string> board(h, string(w, '.'));
+  int num_crystals = 0;
+  for (auto& row : board) {
+    for (char& cell : row) {
+      int t = rand_int(0, 99);
+      if (t < p_crystal) {
+        cell = '0' + rand_int(1, 6);
+        ++num_crystals;
+      } else if (t < p_crystal + p_obstacle) {
+        cell = 'X';
+      }
+    }
+  }
+  int cost_lantern = rand_int(1, 10);
+  int cost_mirror = rand_int(3, 30);
+  int cost_obstacle = rand_int(2, 20);
+  int max_mirrors = rand_int(0, num_crystals / 8);
+  int max_obstacles = rand_int(0, num_crystals / 16);
+
+  cout << h << endl;
+  for (const auto& row : board) {
+    cout << row << endl;
+  }
+  cout << cost_lantern << endl
+       << cost_mirror << endl
+       << cost_obstacle << endl
+       << max_mirrors << endl
+       << max_obstacles << endl;
+  return 0;
+}
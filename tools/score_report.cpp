@@ -0,0 +1,344 @@
+// Compares two results files written by tools/collect_results.sh.
+//
+// Usage: ./tools/score_report.o BASELINE CURRENT
+//
+// Prints how many seeds could be paired (listing those without a score), the
+// paired win/lose/tie counts and totals score_diff.sh used to print,
+// followed by relative scores, 95% confidence intervals of the per-seed
+// differences and breakdowns by board size and item limits.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr const char* COLUMNS[] = {"score",  "iterations",  "run_time",
+                                   "height", "width",       "max_mirrors",
+                                   "max_obstacles"};
+constexpr int NUM_COLUMNS = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+enum Column {
+  SCORE,
+  ITERATIONS,
+  RUN_TIME,
+  HEIGHT,
+  WIDTH,
+  MAX_MIRRORS,
+  MAX_OBSTACLES
+};
+
+// Per-seed values indexed by Column; NaN where the file has "-" or lacks
+// the column.
+using Results = map<string, array<double, NUM_COLUMNS>>;
+
+bool ReadResults(const string& path, Results* results) {
+  ifstream ifs(path);
+  string line;
+  if (!ifs || !getline(ifs, line)) {
+    cerr << "Failed to read " << path << endl;
+    return false;
+  }
+  int seed_index = -1;
+  vector<int> column_of_field;
+  {
+    stringstream ss(line);
+    string name;
+    while (ss >> name) {
+      int column = -1;
+      for (int c = 0; c < NUM_COLUMNS; ++c) {
+        if (name == COLUMNS[c]) {
+          column = c;
+        }
+      }
+      if (name == "seed") {
+        seed_index = column_of_field.size();
+      }
+      column_of_field.push_back(column);
+    }
+  }
+  if (seed_index < 0) {
+    cerr << path << ": missing seed column" << endl;
+    return false;
+  }
+  while (getline(ifs, line)) {
+    stringstream ss(line);
+    string seed;
+    array<double, NUM_COLUMNS> values;
+    values.fill(NAN);
+    string field;
+    for (int i = 0; ss >> field; ++i) {
+      if (i == seed_index) {
+        seed = field;
+      } else if (i < column_of_field.size() && column_of_field[i] >= 0) {
+        char* end;
+        double value = strtod(field.c_str(), &end);
+        if (*end == '\0' && end != field.c_str()) {
+          values[column_of_field[i]] = value;
+        }
+      }
+    }
+    if (!seed.empty()) {
+      (*results)[seed] = values;
+    }
+  }
+  return true;
+}
+
+// 97.5% quantile of Student's t (the two-sided 95% critical value). Exact
+// (to 3 decimals) for df < 30; above that 1.96 + 2.4 / df is within 0.005.
+double TQuantile975(int df) {
+  static const double table[] = {
+      NAN,   12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+      2.228, 2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+      2.086, 2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045};
+  constexpr int kTableSize = sizeof(table) / sizeof(table[0]);
+  if (df < kTableSize) {
+    return table[max(df, 1)];
+  }
+  return 1.96 + 2.4 / df;
+}
+
+struct Summary {
+  int win = 0;
+  int lose = 0;
+  int tie = 0;
+  double prev_total = 0;
+  double curr_total = 0;
+  double prev_relative = 0;
+  double curr_relative = 0;
+  vector<double> score_diffs;
+  vector<double> relative_diffs;
+
+  void Add(double prev, double curr) {
+    if (prev < curr) {
+      ++win;
+    } else if (prev > curr) {
+      ++lose;
+    } else {
+      ++tie;
+    }
+    prev_total += prev;
+    curr_total += curr;
+    // Contest scoring: each seed is worth score / best score.
+    double best = max(max(prev, curr), 0.0);
+    double prev_rel = best > 0 ? max(prev, 0.0) / best : 1.0;
+    double curr_rel = best > 0 ? max(curr, 0.0) / best : 1.0;
+    prev_relative += prev_rel;
+    curr_relative += curr_rel;
+    score_diffs.push_back(curr - prev);
+    relative_diffs.push_back(curr_rel - prev_rel);
+  }
+};
+
+// Mean and half width of its 95% confidence interval.
+pair<double, double> MeanWithCI(const vector<double>& values) {
+  int n = values.size();
+  if (n == 0) {
+    return {0, 0};
+  }
+  double mean = 0;
+  for (double v : values) {
+    mean += v;
+  }
+  mean /= n;
+  if (n == 1) {
+    return {mean, INFINITY};
+  }
+  double var = 0;
+  for (double v : values) {
+    var += (v - mean) * (v - mean);
+  }
+  var /= n - 1;
+  return {mean, TQuantile975(n - 1) * sqrt(var / n)};
+}
+
+string FormatCI(const vector<double>& values, int precision) {
+  auto ci = MeanWithCI(values);
+  stringstream ss;
+  ss << fixed << setprecision(precision) << showpos << ci.first
+     << noshowpos << " +- " << ci.second;
+  return ss.str();
+}
+
+// Two-sided sign test on wins vs losses, normal approximation.
+double SignTestP(int win, int lose) {
+  if (win + lose == 0) {
+    return 1;
+  }
+  double z = (win - lose) / sqrt(double(win + lose));
+  return erfc(abs(z) / sqrt(2.0));
+}
+
+struct Bucket {
+  string name;
+  double lo;
+  double hi;
+};
+
+void PrintBreakdown(const string& title, const vector<Bucket>& buckets,
+                    const map<string, double>& keys,
+                    const map<string, pair<double, double>>& scores) {
+  cout << endl << title << endl;
+  cout << setw(12) << "bucket" << setw(6) << "n" << setw(6) << "win"
+       << setw(6) << "lose" << setw(6) << "tie"
+       << "  relative_diff (95% CI)" << endl;
+  for (const auto& bucket : buckets) {
+    Summary summary;
+    for (const auto& entry : scores) {
+      auto key = keys.find(entry.first);
+      if (key != keys.end() && bucket.lo <= key->second &&
+          key->second < bucket.hi) {
+        summary.Add(entry.second.first, entry.second.second);
+      }
+    }
+    if (summary.score_diffs.empty()) {
+      continue;
+    }
+    cout << setw(12) << bucket.name << setw(6) << summary.score_diffs.size()
+         << setw(6) << summary.win << setw(6) << summary.lose << setw(6)
+         << summary.tie << "  " << FormatCI(summary.relative_diffs, 4)
+         << endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " BASELINE CURRENT" << endl;
+    return 1;
+  }
+  Results prev, curr;
+  if (!ReadResults(argv[1], &prev) || !ReadResults(argv[2], &curr)) {
+    return 1;
+  }
+
+  Summary summary;
+  map<string, pair<double, double>> scores;
+  map<string, double> sizes, mirror_limits, obstacle_limits;
+  vector<double> log_speedups;
+  double prev_time = 0, curr_time = 0;
+  int timed = 0;
+  // Seeds left out of the comparison, so a crash or a timeout that leaves
+  // no score does not go unnoticed.
+  int only_prev = 0, only_curr = 0;
+  vector<string> prev_unscored, curr_unscored;
+  for (const auto& entry : prev) {
+    if (!curr.count(entry.first)) {
+      ++only_prev;
+    }
+  }
+  for (const auto& entry : curr) {
+    auto base = prev.find(entry.first);
+    if (base == prev.end()) {
+      ++only_curr;
+      continue;
+    }
+    if (std::isnan(base->second[SCORE])) {
+      prev_unscored.push_back(entry.first);
+    }
+    if (std::isnan(entry.second[SCORE])) {
+      curr_unscored.push_back(entry.first);
+    }
+    if (std::isnan(base->second[SCORE]) || std::isnan(entry.second[SCORE])) {
+      continue;
+    }
+    const auto& p = base->second;
+    const auto& c = entry.second;
+    summary.Add(p[SCORE], c[SCORE]);
+    scores[entry.first] = {p[SCORE], c[SCORE]};
+
+    // Board properties depend only on the seed; take whichever file has them.
+    auto known = [&](Column column) {
+      return std::isnan(c[column]) ? p[column] : c[column];
+    };
+    if (!std::isnan(known(HEIGHT)) && !std::isnan(known(WIDTH))) {
+      sizes[entry.first] = sqrt(known(HEIGHT) * known(WIDTH));
+    }
+    if (!std::isnan(known(MAX_MIRRORS))) {
+      mirror_limits[entry.first] = known(MAX_MIRRORS);
+    }
+    if (!std::isnan(known(MAX_OBSTACLES))) {
+      obstacle_limits[entry.first] = known(MAX_OBSTACLES);
+    }
+    if (p[ITERATIONS] > 0 && c[ITERATIONS] > 0 && p[RUN_TIME] > 0 &&
+        c[RUN_TIME] > 0) {
+      log_speedups.push_back(log((c[ITERATIONS] / c[RUN_TIME]) /
+                                 (p[ITERATIONS] / p[RUN_TIME])));
+      prev_time += p[RUN_TIME];
+      curr_time += c[RUN_TIME];
+      ++timed;
+    }
+  }
+
+  auto print_seeds = [](const string& name, const vector<string>& seeds) {
+    cout << name << " = " << seeds.size();
+    for (const auto& seed : seeds) {
+      cout << " " << seed;
+    }
+    cout << endl;
+  };
+  cout << "matched_seeds = " << scores.size() << endl;
+  cout << "only_in_baseline = " << only_prev << endl;
+  cout << "only_in_current = " << only_curr << endl;
+  print_seeds("no_score_in_baseline", prev_unscored);
+  print_seeds("no_score_in_current", curr_unscored);
+
+  cout << fixed << setprecision(1);
+  cout << "win = " << summary.win << endl;
+  cout << "lose = " << summary.lose << endl;
+  cout << "tie = " << summary.tie << endl;
+  cout << "prev_total = " << summary.prev_total << endl;
+  cout << "curr_total = " << summary.curr_total << endl;
+  cout << setprecision(3);
+  cout << "prev_relative = " << summary.prev_relative << endl;
+  cout << "curr_relative = " << summary.curr_relative << endl;
+  cout << "score_diff = " << FormatCI(summary.score_diffs, 2) << endl;
+  cout << "relative_diff = " << FormatCI(summary.relative_diffs, 4) << endl;
+  cout << "sign_test_p = " << setprecision(4)
+       << SignTestP(summary.win, summary.lose) << endl;
+  auto relative_ci = MeanWithCI(summary.relative_diffs);
+  cout << "verdict = "
+       << (relative_ci.first - relative_ci.second > 0
+               ? "better"
+               : relative_ci.first + relative_ci.second < 0 ? "worse"
+                                                            : "noise")
+       << endl;
+  if (timed) {
+    auto speedup = MeanWithCI(log_speedups);
+    cout << setprecision(3);
+    cout << "iterations_per_second_ratio = " << exp(speedup.first) << " ["
+         << exp(speedup.first - speedup.second) << ", "
+         << exp(speedup.first + speedup.second) << "]" << endl;
+    cout << "prev_mean_run_time = " << prev_time / timed << endl;
+    cout << "curr_mean_run_time = " << curr_time / timed << endl;
+  }
+
+  PrintBreakdown("by board size (sqrt(H * W))",
+                 {{"10-29", 10, 30},
+                  {"30-49", 30, 50},
+                  {"50-69", 50, 70},
+                  {"70-89", 70, 90},
+                  {"90-100", 90, 101}},
+                 sizes, scores);
+  PrintBreakdown("by max mirrors",
+                 {{"0", 0, 1},
+                  {"1-9", 1, 10},
+                  {"10-49", 10, 50},
+                  {"50-149", 50, 150},
+                  {"150+", 150, INFINITY}},
+                 mirror_limits, scores);
+  PrintBreakdown("by max obstacles",
+                 {{"0", 0, 1},
+                  {"1-4", 1, 5},
+                  {"5-24", 5, 25},
+                  {"25-74", 25, 75},
+                  {"75+", 75, INFINITY}},
+                 obstacle_limits, scores);
+  return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/bash -e
+
+# Runs an instrumented binary on every 100th seed of testset.txt so that
+# the profile covers the whole range of board sizes and item limits.
+#
+# The inputs come from tools/gen_input.o and the binary is run directly:
+# the visualizer may kill the solution once it has read the answer, which
+# can leave the profile files unwritten or truncated.
+
+readonly EXEC=$1
+readonly INPUT_DIR=$(dirname "${EXEC}")
+
+test_case=0
+while read test_seed; do
+  if [ $((test_case % 100)) -eq 0 ]; then
+    echo "Train on seed "${test_seed}
+    input="${INPUT_DIR}/input_${test_seed}.txt"
+    ./tools/gen_input.o ${test_seed} >"${input}"
+    "${EXEC}" <"${input}" >/dev/null 2>&1
+  fi
+  test_case=$((test_case+1))
+done <testset.txt
@@ -0,0 +1,311 @@
+// Racing tuner for EnergyParams, in the spirit of irace's F-race.
+//
+// Every iteration samples candidates around the incumbent and races them on
+// seeds from testset.txt: candidates are run on one block of seeds at a time
+// (in parallel, one visualizer process per thread) and dropped as soon as a
+// paired t-test on relative scores says they are worse than the current
+// leader. The winner of each race becomes the next incumbent and is written
+// to the output file.
+//
+// Usage: ./tools/tune.o [-params FILE] [-output FILE] [-workdir DIR]
+//                       [-iterations N] [-candidates N] [-threads N]
+//                       [-min-seeds N] [-max-seeds N] [-sigma X] [-seed N]
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "../main.cpp"
+
+struct TuneOptions {
+  string params_path;
+  string output_path = "tuning/best_params.txt";
+  string workdir = "tuning";
+  int iterations = 10;
+  int candidates = 8;
+  int threads = thread::hardware_concurrency();
+  int min_seeds = 16;
+  int max_seeds = 96;
+  double sigma = 0.3;
+  int seed = 0;
+};
+
+struct Candidate {
+  EnergyParams params;
+  string params_path;
+  bool alive = true;
+  // Score on each raced seed, in race order; NaN if not run.
+  vector<double> scores;
+};
+
+// Runs the visualizer on one seed and returns the reported score.
+double Evaluate(const string& params_path, const string& seed) {
+  string command = "CRYSTAL_LIGHTING_PARAMS=" + params_path +
+                   " java CrystalLightingVis -exec ./release.o -seed " + seed +
+                   " -novis";
+  FILE* pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    return NAN;
+  }
+  double score = NAN;
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), pipe)) {
+    sscanf(buffer, "Score = %lf", &score);
+  }
+  pclose(pipe);
+  return score;
+}
+
+// Runs every alive candidate on seeds [begin, end) using a shared job queue.
+void RunBlock(const vector<string>& seeds, int begin, int end, int threads,
+              vector<Candidate>* candidates) {
+  vector<pair<int, int>> jobs;
+  for (int i = 0; i < candidates->size(); ++i) {
+    if ((*candidates)[i].alive) {
+      (*candidates)[i].scores.resize(end, NAN);
+      for (int s = begin; s < end; ++s) {
+        jobs.emplace_back(i, s);
+      }
+    }
+  }
+  atomic<int> next_job(0);
+  mutex log_mutex;
+  auto worker = [&]() {
+    for (int j; (j = next_job++) < jobs.size();) {
+      Candidate& candidate = (*candidates)[jobs[j].first];
+      double score = Evaluate(candidate.params_path, seeds[jobs[j].second]);
+      candidate.scores[jobs[j].second] = score;
+      lock_guard<mutex> lock(log_mutex);
+      cerr << "  candidate " << jobs[j].first << ", seed "
+           << seeds[jobs[j].second] << ": " << score << endl;
+    }
+  };
+  vector<thread> pool;
+  for (int t = 0; t < max(threads, 1); ++t) {
+    pool.emplace_back(worker);
+  }
+  for (auto& t : pool) {
+    t.join();
+  }
+}
+
+// Per-seed relative scores (score / best score on that seed), the same
+// normalization the contest uses.
+vector<vector<double>> GetRelativeScores(const vector<Candidate>& candidates,
+                                         int num_seeds) {
+  vector<vector<double>> relative(candidates.size(),
+                                  vector<double>(num_seeds, NAN));
+  for (int s = 0; s < num_seeds; ++s) {
+    double best = 0;
+    for (const auto& candidate : candidates) {
+      if (s < candidate.scores.size() && !std::isnan(candidate.scores[s])) {
+        best = max(best, candidate.scores[s]);
+      }
+    }
+    for (int i = 0; i < candidates.size(); ++i) {
+      const auto& scores = candidates[i].scores;
+      if (s < scores.size() && !std::isnan(scores[s])) {
+        relative[i][s] = best > 0 ? max(scores[s], 0.0) / best : 1.0;
+      }
+    }
+  }
+  return relative;
+}
+
+double Mean(const vector<double>& values) {
+  double sum = 0;
+  int n = 0;
+  for (double v : values) {
+    if (!std::isnan(v)) {
+      sum += v;
+      ++n;
+    }
+  }
+  return n ? sum / n : 0;
+}
+
+// Paired t statistic of (a - b) over seeds where both were run.
+double PairedT(const vector<double>& a, const vector<double>& b) {
+  vector<double> diffs;
+  for (int s = 0; s < a.size(); ++s) {
+    if (!std::isnan(a[s]) && !std::isnan(b[s])) {
+      diffs.push_back(a[s] - b[s]);
+    }
+  }
+  if (diffs.size() < 2) {
+    return 0;
+  }
+  double mean = accumulate(diffs.begin(), diffs.end(), 0.0) / diffs.size();
+  double var = 0;
+  for (double d : diffs) {
+    var += (d - mean) * (d - mean);
+  }
+  var /= diffs.size() - 1;
+  if (var == 0) {
+    return mean > 0 ? INFINITY : (mean < 0 ? -INFINITY : 0);
+  }
+  return mean / sqrt(var / diffs.size());
+}
+
+// Fields Perturb() may change. The exceeded_* penalties are left out: the
+// search never places items beyond the limits, so they cannot affect a run.
+vector<double EnergyParams::*> GetTunableFields() {
+  vector<double EnergyParams::*> tunable;
+  for (const auto& field : GetEnergyParamFields()) {
+    if (field.first != "exceeded_mirror" &&
+        field.first != "exceeded_obstacle") {
+      tunable.push_back(field.second);
+    }
+  }
+  return tunable;
+}
+
+EnergyParams Perturb(const EnergyParams& params, double sigma, mt19937* gen) {
+  EnergyParams perturbed = params;
+  static const auto fields = GetTunableFields();
+  normal_distribution<double> rand_log_factor(0, sigma);
+  uniform_real_distribution<double> rand_prob(0, 1);
+  bool changed = false;
+  while (!changed) {
+    for (const auto field : fields) {
+      if (rand_prob(*gen) < 3.0 / fields.size()) {
+        perturbed.*field *= exp(rand_log_factor(*gen));
+        changed = true;
+      }
+    }
+  }
+  return perturbed;
+}
+
+bool WriteParamsFile(const string& path, const EnergyParams& params) {
+  ofstream ofs(path);
+  WriteEnergyParams(ofs, params);
+  return bool(ofs);
+}
+
+bool ParseOptions(int argc, char** argv, TuneOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (i + 1 >= argc) {
+      cerr << "Missing value for " << arg << endl;
+      return false;
+    }
+    string value = argv[++i];
+    if (arg == "-params") {
+      options->params_path = value;
+    } else if (arg == "-output") {
+      options->output_path = value;
+    } else if (arg == "-workdir") {
+      options->workdir = value;
+    } else if (arg == "-iterations") {
+      options->iterations = atoi(value.c_str());
+    } else if (arg == "-candidates") {
+      options->candidates = atoi(value.c_str());
+    } else if (arg == "-threads") {
+      options->threads = atoi(value.c_str());
+    } else if (arg == "-min-seeds") {
+      options->min_seeds = atoi(value.c_str());
+    } else if (arg == "-max-seeds") {
+      options->max_seeds = atoi(value.c_str());
+    } else if (arg == "-sigma") {
+      options->sigma = atof(value.c_str());
+    } else if (arg == "-seed") {
+      options->seed = atoi(value.c_str());
+    } else {
+      cerr << "Unknown option " << arg << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  TuneOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+
+  EnergyParams incumbent;
+  if (!options.params_path.empty()) {
+    ifstream ifs(options.params_path);
+    if (!ifs || !ReadEnergyParams(ifs, &incumbent)) {
+      cerr << "Failed to read parameters from " << options.params_path << endl;
+      return 1;
+    }
+  }
+
+  vector<string> seeds;
+  {
+    ifstream ifs("testset.txt");
+    for (string seed; ifs >> seed;) {
+      seeds.push_back(seed);
+    }
+  }
+  if (seeds.empty()) {
+    cerr << "testset.txt is empty" << endl;
+    return 1;
+  }
+  mt19937 gen(options.seed);
+  const int block = max(options.threads, 1);
+
+  for (int iteration = 0; iteration < options.iterations; ++iteration) {
+    shuffle(seeds.begin(), seeds.end(), gen);
+    const int max_seeds = min<int>(options.max_seeds, seeds.size());
+
+    vector<Candidate> candidates(max(options.candidates, 1));
+    for (int i = 0; i < candidates.size(); ++i) {
+      candidates[i].params =
+          i == 0 ? incumbent : Perturb(incumbent, options.sigma, &gen);
+      candidates[i].params_path =
+          options.workdir + "/candidate_" + to_string(i) + ".txt";
+      if (!WriteParamsFile(candidates[i].params_path, candidates[i].params)) {
+        cerr << "Failed to write " << candidates[i].params_path << endl;
+        return 1;
+      }
+    }
+
+    int num_alive = candidates.size();
+    int raced = 0;
+    int leader = 0;
+    while (raced < max_seeds && num_alive > 1) {
+      int end = min(raced + block, max_seeds);
+      RunBlock(seeds, raced, end, options.threads, &candidates);
+      raced = end;
+
+      auto relative = GetRelativeScores(candidates, raced);
+      for (int i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].alive &&
+            Mean(relative[i]) > Mean(relative[leader])) {
+          leader = i;
+        }
+      }
+      if (raced < options.min_seeds) {
+        continue;
+      }
+      for (int i = 0; i < candidates.size(); ++i) {
+        // One-sided test at roughly the 95% level.
+        if (i != leader && candidates[i].alive &&
+            PairedT(relative[leader], relative[i]) > 1.7) {
+          candidates[i].alive = false;
+          --num_alive;
+        }
+      }
+      cerr << "iteration " << iteration << ": " << raced << " seeds, "
+           << num_alive << " alive, leader = " << leader << endl;
+    }
+
+    auto relative = GetRelativeScores(candidates, raced);
+    cerr << "iteration " << iteration << " winner = candidate " << leader
+         << " (mean relative score " << Mean(relative[leader])
+         << ", incumbent " << Mean(relative[0]) << ")" << endl;
+    incumbent = candidates[leader].params;
+    if (!WriteParamsFile(options.output_path, incumbent)) {
+      cerr << "Failed to write " << options.output_path << endl;
+      return 1;
+    }
+  }
+
+  WriteEnergyParams(cout, incumbent);
+  return 0;
+}
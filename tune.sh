@@ -0,0 +1,6 @@
+#!/bin/bash -e
+
+make release.o CrystalLightingVis.class tools/tune.o
+
+mkdir -p tuning
+./tools/tune.o "$@"
@@ -11,4 +11,5 @@ mkdir scores
 ./tools/update_score_worker.sh 601 800 &
 wait
 
+./tools/collect_results.sh > results.txt
 ./score_diff.sh | tee score.txt